@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/vector.h"
+#include "../src/vector_numa.h"
+
+/*
+ * Measures how long it takes to reserve a vector and write every element
+ * once, with the pages faulted in by that sequential write, or up front by
+ * vector_reserve_parallel with each policy
+ *
+ * Usage: ./first_touch [megabytes] [threads]
+ */
+
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+static void fill(long *vector, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    vector[i] = (long)i;
+  }
+  __vector_set_size(vector, count);
+}
+
+static void report(const char *name, double reserve, double write) {
+  printf("%-12s reserve %8.2f ms  write %8.2f ms  total %8.2f ms\n", name,
+         reserve * 1e3, write * 1e3, (reserve + write) * 1e3);
+}
+
+int main(int argc, char **argv) {
+  size_t megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 1024;
+  size_t threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+  size_t count = megabytes * 1024 * 1024 / sizeof(long);
+
+  const char *names[] = {"sequential", "partition", "interleave"};
+  for (int run = 0; run < 3; run++) {
+    long *vector = NULL;
+    double start = now();
+    if (run == 0) {
+      vector_reserve(vector, count);
+    } else {
+      vector_reserve_parallel(vector, count, threads,
+                              run == 1 ? VECTOR_NUMA_PARTITION
+                                       : VECTOR_NUMA_INTERLEAVE);
+    }
+    double reserved = now();
+    fill(vector, count);
+    double written = now();
+    report(names[run], reserved - start, written - reserved);
+    vector_free(vector);
+  }
+  return 0;
+}
@@ -0,0 +1,485 @@
+/**************************************************************************************************
+ * License: MIT *
+ **************************************************************************************************
+ * Copyright 2020 Scott Nicholas Hackman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef DELTA_VECTOR_H
+#define DELTA_VECTOR_H
+
+#include <stdint.h> // uint8_t, uint64_t, int64_t
+#include <string.h> // memcpy, memset
+
+#include "vector.h"
+
+/*
+ * Delta_Vector a compressed vector of 64 bit integers
+ *
+ * Meant for sorted ids, timestamps and posting lists where neighbouring
+ * values are close together. Values are grouped into blocks of
+ * DELTA_VECTOR_BLOCK, every full block stores its first value in a skip
+ * table and the remaining values as zigzag encoded deltas bit-packed to the
+ * width of the largest delta in that block (Frame Of Reference).
+ *
+ * use #define DELTA_VECTOR_BLOCK to change the block size, must be > 1
+ *
+ * Convention:
+ * skip, offsets and data are C_Vectors, so their size and capacity live
+ * in the usual header in front of them.
+ *
+ * Internally:
+ *
+ * skip    -> | first value of block 0 | first value of block 1 | ... |
+ * offsets -> | byte offset of block 0 | byte offset of block 1 | ... |
+ * data    -> | width | packed deltas ... | width | packed deltas ... |
+ * tail    -> last size % DELTA_VECTOR_BLOCK values, not yet packed
+ *
+ *  Memory Usage:
+ *
+ *  per block: sizeof(uint64_t) + sizeof(size_t) + 1 +
+ *             ceil((DELTA_VECTOR_BLOCK - 1) * width / 8)
+ *
+ * Core Library Functions:
+ * 		Accessors:
+ * 			size, blocks, block_front, at, seek
+ *
+ * 		Modifier:
+ * 			push_back, decode_block, decode, free
+ *
+ * ---------------------------------------------------------------------
+ * Example                                                             |
+ * ---------------------------------------------------------------------
+ * delta_vector ids = {0};                                             |
+ * for (uint64_t i = 0; i < 1000; i++) {                               |
+ *      delta_vector_push_back(&ids, i * 3);                           |
+ * }                                                                   |
+ *                                                                     |
+ * printf("ids[500] = %lu\n", delta_vector_at(&ids, 500));             |
+ *                                                                     |
+ * uint64_t* decoded = NULL;                                           |
+ * delta_vector_decode(&ids, decoded);                                 |
+ * vector_free(decoded);                                               |
+ * delta_vector_free(&ids);                                            |
+ * ---------------------------------------------------------------------
+ */
+
+#ifndef DELTA_VECTOR_BLOCK
+#define DELTA_VECTOR_BLOCK 128
+#endif // DELTA_VECTOR_BLOCK
+
+typedef struct delta_vector {
+  size_t size;
+  uint64_t *skip;
+  size_t *offsets;
+  uint8_t *data;
+  uint64_t tail[DELTA_VECTOR_BLOCK];
+} delta_vector;
+
+/*
+ * Description: Returns the number of values stored in delta_vector
+ *
+ * Type: Accessor
+ *
+ * Params:
+ *
+ * 	dv: the delta_vector to get the size of
+ *
+ * Time Complexity: Constant
+ *
+ * Memory:
+ *
+ *  0
+ *
+ * 	Return: size_t, the number of values
+ */
+static inline size_t delta_vector_size(const delta_vector *dv) {
+  return dv ? dv->size : 0;
+}
+
+/*
+ * Description: Returns the number of blocks, including the unpacked tail
+ *
+ * Type: Accessor
+ *
+ * Params:
+ *
+ * 	dv: the delta_vector to count the blocks of
+ *
+ * Time Complexity: Constant
+ *
+ * Memory:
+ *
+ *  0
+ *
+ * 	Return: size_t, the number of blocks
+ */
+static inline size_t delta_vector_blocks(const delta_vector *dv) {
+  return (delta_vector_size(dv) + DELTA_VECTOR_BLOCK - 1) / DELTA_VECTOR_BLOCK;
+}
+
+/*
+ * Description: Returns the first value of block, read from the skip table
+ *
+ * Type: Accessor
+ *
+ * Params:
+ *
+ * 	dv: the delta_vector to read from
+ *
+ * 	block: index of the block, must be < delta_vector_blocks(dv)
+ *
+ * Time Complexity: Constant
+ *
+ * Memory:
+ *
+ *  0
+ *
+ * 	Return: uint64_t, the first value of block
+ */
+static inline uint64_t delta_vector_block_front(const delta_vector *dv,
+                                                size_t block) {
+  if (block < vector_size(dv->skip)) {
+    return dv->skip[block];
+  }
+  return dv->tail[0];
+}
+
+/*
+ * Internal function:
+ * Number of bits needed to store value, 0 for 0
+ */
+static inline unsigned __delta_vector_width(uint64_t value) {
+  unsigned width = 0;
+  while (value) {
+    width++;
+    value >>= 1;
+  }
+  return width;
+}
+
+/*
+ * Internal function:
+ * Loads 8 little endian bytes from in, which doesn't need to be aligned
+ */
+static inline uint64_t __delta_vector_load64(const uint8_t *in) {
+  uint64_t word;
+  memcpy(&word, in, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  return word;
+}
+
+/*
+ * Internal function:
+ * Adds the zigzag encoded delta to value
+ */
+static inline uint64_t __delta_vector_undelta(uint64_t value,
+                                              uint64_t zigzag) {
+  return value + ((zigzag >> 1) ^ (0 - (zigzag & 1)));
+}
+
+/*
+ * Internal function:
+ * Packs the full tail as a new block
+ *
+ * Logic:
+ * zigzag encode the deltas between neighbouring tail values, so decreasing
+ * sequences stay small, find the widest one, then append
+ * | width | deltas 1 .. DELTA_VECTOR_BLOCK - 1 | to data, padded to a byte
+ * The first value goes to the skip table instead of data
+ * data always has 8 bytes of capacity past its size, so decoding can load
+ * 64 bits at any bit of the last block
+ */
+static inline void __delta_vector_pack(delta_vector *dv) {
+  uint64_t zigzag[DELTA_VECTOR_BLOCK];
+  uint64_t widest = 0;
+  for (size_t i = 1; i < DELTA_VECTOR_BLOCK; i++) {
+    uint64_t delta = dv->tail[i] - dv->tail[i - 1];
+    zigzag[i] = (delta << 1) ^ (uint64_t)((int64_t)delta >> 63);
+    widest |= zigzag[i];
+  }
+  unsigned width = __delta_vector_width(widest);
+  size_t offset = vector_size(dv->data);
+  size_t bytes = 1 + ((DELTA_VECTOR_BLOCK - 1) * width + 7) / 8;
+
+  vector_push_back(dv->skip, dv->tail[0]);
+  vector_push_back(dv->offsets, offset);
+  if (vector_capacity(dv->data) < offset + bytes + 8) {
+    size_t capacity = 2 * vector_capacity(dv->data);
+    dv->data = __vector_alloc(
+        dv->data, capacity > offset + bytes + 8 ? capacity : offset + bytes + 8,
+        sizeof(*(dv->data)));
+  }
+
+  uint8_t *out = dv->data + offset;
+  memset(out, 0, bytes);
+  out[0] = (uint8_t)width;
+  size_t bit = 8;
+  for (size_t i = 1; i < DELTA_VECTOR_BLOCK; i++) {
+    uint64_t value = zigzag[i];
+    for (unsigned left = width; left > 0;) {
+      unsigned shift = bit & 7;
+      unsigned taken = 8 - shift < left ? 8 - shift : left;
+      out[bit >> 3] |= (uint8_t)(value << shift);
+      value >>= taken;
+      bit += taken;
+      left -= taken;
+    }
+  }
+  __vector_set_size(dv->data, offset + bytes);
+}
+
+/*
+ * Description: Inserts value at the end of delta_vector
+ *
+ * Type: Modifier (Insertion)
+ *
+ * Params:
+ *
+ * 	dv: the delta_vector to modify
+ *
+ * 	value: the new value to append to the end of dv
+ *
+ * Time Complexity: Amortized constant
+ *
+ * Memory:
+ * 	Case of size % DELTA_VECTOR_BLOCK == 0:
+ * 		one packed block, see Memory Usage above
+ *
+ * 	Return: void
+ */
+static inline void delta_vector_push_back(delta_vector *dv, uint64_t value) {
+  dv->tail[dv->size % DELTA_VECTOR_BLOCK] = value;
+  dv->size++;
+  if (dv->size % DELTA_VECTOR_BLOCK == 0) {
+    __delta_vector_pack(dv);
+  }
+}
+
+/*
+ * Internal function:
+ * Decodes the first count values of block into out
+ *
+ * Logic:
+ * value i - 1 of the packed deltas starts at bit (i - 1) * width, load the
+ * 64 bits around it and shift it down. Up to width 56 a value always fits in
+ * that load, wider ones take their top bits from the byte after it
+ */
+static inline void __delta_vector_unpack(const delta_vector *dv, size_t block,
+                                         size_t count, uint64_t *out) {
+  if (block >= vector_size(dv->skip)) {
+    memcpy(out, dv->tail, count * sizeof(*out));
+    return;
+  }
+
+  const uint8_t *in = dv->data + dv->offsets[block];
+  unsigned width = *in++;
+  uint64_t mask = width < 64 ? ((uint64_t)1 << width) - 1 : ~(uint64_t)0;
+  uint64_t value = dv->skip[block];
+  out[0] = value;
+  if (width <= 56) {
+    for (size_t i = 1; i < count; i++) {
+      size_t bit = (i - 1) * width;
+      out[i] = (__delta_vector_load64(in + (bit >> 3)) >> (bit & 7)) & mask;
+    }
+    for (size_t i = 1; i < count; i++) {
+      value = __delta_vector_undelta(value, out[i]);
+      out[i] = value;
+    }
+  } else {
+    size_t bit = 0;
+    for (size_t i = 1; i < count; i++, bit += width) {
+      unsigned shift = bit & 7;
+      uint64_t zigzag = __delta_vector_load64(in + (bit >> 3)) >> shift;
+      if (shift) {
+        zigzag |= (uint64_t)in[(bit >> 3) + 8] << (64 - shift);
+      }
+      value = __delta_vector_undelta(value, zigzag & mask);
+      out[i] = value;
+    }
+  }
+}
+
+/*
+ * Description: Decodes block into out
+ *
+ * Type: Accessor
+ *
+ * Params:
+ *
+ * 	dv: the delta_vector to read from
+ *
+ * 	block: index of the block, must be < delta_vector_blocks(dv)
+ *
+ * 	out: buffer with room for DELTA_VECTOR_BLOCK values
+ *
+ * Time Complexity: Linear in DELTA_VECTOR_BLOCK
+ *
+ * Memory:
+ *
+ *  0
+ *
+ * 	Return: size_t, the number of values written to out
+ */
+static inline size_t delta_vector_decode_block(const delta_vector *dv,
+                                               size_t block, uint64_t *out) {
+  size_t count = block < vector_size(dv->skip)
+                     ? DELTA_VECTOR_BLOCK
+                     : dv->size % DELTA_VECTOR_BLOCK;
+  __delta_vector_unpack(dv, block, count, out);
+  return count;
+}
+
+/*
+ * Description: Returns the value at index
+ *
+ * Type: Accessor
+ *
+ * Params:
+ *
+ * 	dv: the delta_vector to read from
+ *
+ * 	index: position of the value, must be < delta_vector_size(dv)
+ *
+ * Time Complexity: Linear in index % DELTA_VECTOR_BLOCK
+ *
+ * Memory:
+ *
+ *  0
+ *
+ * 	Return: uint64_t, the value at index
+ */
+static inline uint64_t delta_vector_at(const delta_vector *dv, size_t index) {
+  uint64_t block[DELTA_VECTOR_BLOCK];
+  size_t position = index % DELTA_VECTOR_BLOCK;
+  __delta_vector_unpack(dv, index / DELTA_VECTOR_BLOCK, position + 1, block);
+  return block[position];
+}
+
+/*
+ * Description: Finds the last block whose first value is <= value, using
+ * 		only the skip table. delta_vector must be sorted ascending
+ *
+ * Type: Accessor (Query)
+ *
+ * Params:
+ *
+ * 	dv: the delta_vector to search
+ *
+ * 	value: the value to look for
+ *
+ * Time Complexity: Logarithmic in the number of blocks
+ *
+ * Memory:
+ *
+ *  0
+ *
+ * 	Return: size_t, index of the block that may contain value, 0 if value
+ * 		is smaller than every value in dv
+ */
+static inline size_t delta_vector_seek(const delta_vector *dv,
+                                       uint64_t value) {
+  size_t low = 0;
+  size_t high = delta_vector_blocks(dv);
+  while (high - low > 1) {
+    size_t middle = low + (high - low) / 2;
+    if (delta_vector_block_front(dv, middle) <= value) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+/*
+ * Description: Appends every value of delta_vector to the end of vector
+ *
+ * Type: Modifier (Insertion)
+ *
+ * Params:
+ *
+ * 	dv: the delta_vector to decode
+ *
+ * 	vector: the vector to append to, of any integer TYPE, uint64_t and
+ * 		int64_t vectors are decoded into directly
+ *
+ * Time Complexity: Linear
+ *
+ * Memory:
+ * 	Case of vector_size(vector) + size >= capacity:
+ * 		sizeof(*(vector)) bytes * (vector_size(vector) + size) + 2 *
+ * sizeof(size_t)
+ *
+ * 	Return: void
+ */
+#define delta_vector_decode(dv, vector)                                        \
+  do {                                                                         \
+    const delta_vector *__dv = (dv);                                           \
+    size_t __size = vector_size(vector);                                       \
+    vector_reserve(vector, __size + __dv->size);                               \
+    uint64_t *__direct = _Generic((vector), uint64_t *                         \
+                                  : (uint64_t *)(vector), int64_t *            \
+                                  : (uint64_t *)(vector), default              \
+                                  : NULL);                                     \
+    uint64_t __block[DELTA_VECTOR_BLOCK];                                      \
+    for (size_t __b = 0; __b < delta_vector_blocks(__dv); __b++) {             \
+      if (__direct) {                                                          \
+        __size += delta_vector_decode_block(__dv, __b, __direct + __size);     \
+        continue;                                                              \
+      }                                                                        \
+      size_t __count = delta_vector_decode_block(__dv, __b, __block);          \
+      for (size_t __i = 0; __i < __count; __i++) {                             \
+        (vector)[__size++] = __block[__i];                                     \
+      }                                                                        \
+    }                                                                          \
+    __vector_set_size(vector, __size);                                         \
+  } while (0)
+
+/*
+ * Description: Frees delta_vector's blocks and resets it to empty
+ *
+ * Type: Modifier (Free)
+ *
+ * Params:
+ *
+ * 	dv: delta_vector to free
+ *
+ * Time Complexity: constant
+ *
+ * Memory:
+ *
+ * 	-(every packed block)
+ *
+ * 	Return: void
+ */
+static inline void delta_vector_free(delta_vector *dv) {
+  vector_free(dv->skip);
+  vector_free(dv->offsets);
+  vector_free(dv->data);
+  dv->skip = NULL;
+  dv->offsets = NULL;
+  dv->data = NULL;
+  dv->size = 0;
+}
+
+#endif // DELTA_VECTOR_H
@@ -0,0 +1,311 @@
+/**************************************************************************************************
+ * License: MIT *
+ **************************************************************************************************
+ * Copyright 2020 Scott Nicholas Hackman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef VECTOR_BUILDER_H
+#define VECTOR_BUILDER_H
+
+#include <pthread.h> // pthread_create, pthread_join
+#include <stdlib.h>  // abort
+#include <string.h>  // memcpy
+#include <unistd.h>  // sysconf
+
+#include "vector.h"
+
+/*
+ * Vector_Builder collects the vectors of many threads into one vector
+ *
+ * Every thread appends to its own vector with vector_push_back, no locks,
+ * then hands it to the builder with vector_builder_submit. finish reserves
+ * the destination once, using the prefix sums of the submitted sizes, and
+ * copies the vectors in parallel into their final position, in thread
+ * index order.
+ *
+ * use #define VECTOR_BUILDER_PARALLEL_BYTES to change the size below which
+ * finish copies on the calling thread, defaults to 1 MiB
+ *
+ * Internally:
+ *
+ * locals -> | thread 0 vector | thread 1 vector | ... | NULL | ... |
+ *
+ * destination after finish:
+ * ------------------------------------------------------------------
+ * | old elements | thread 0 elements | thread 1 elements | ...      |
+ * ------------------------------------------------------------------
+ *
+ * ---------------------------------------------------------------------
+ * Example                                                             |
+ * ---------------------------------------------------------------------
+ * vector_builder builder = vector_builder_init(int, threads);         |
+ *                                                                     |
+ * // in thread t                                                      |
+ * int* local = NULL;                                                  |
+ * for (int i = 0; i < 1000; i++) {                                    |
+ *      vector_push_back(local, i);                                    |
+ * }                                                                   |
+ * vector_builder_submit(&builder, t, local);                          |
+ *                                                                     |
+ * // after joining the threads                                        |
+ * int* results = NULL;                                                |
+ * vector_builder_finish(&builder, results);                           |
+ * vector_builder_free(&builder);                                      |
+ * ---------------------------------------------------------------------
+ *
+ * Note: link with -lpthread
+ */
+
+#ifndef VECTOR_BUILDER_PARALLEL_BYTES
+#define VECTOR_BUILDER_PARALLEL_BYTES ((size_t)1 << 20)
+#endif // VECTOR_BUILDER_PARALLEL_BYTES
+
+typedef struct vector_builder {
+  size_t threads;
+  size_t item_size;
+  void **locals;
+} vector_builder;
+
+/*
+ * Internal struct:
+ * Byte range [begin, end) of the submitted vectors, as if they were
+ * concatenated, for one copying thread to write to destination
+ */
+typedef struct __vector_builder_range {
+  const vector_builder *builder;
+  char *destination;
+  size_t begin;
+  size_t end;
+} __vector_builder_range;
+
+/*
+ * Internal function:
+ * Creates a builder with threads empty slots
+ */
+static inline vector_builder __vector_builder_init(size_t threads,
+                                                   size_t size_of_item) {
+  vector_builder builder = {threads, size_of_item,
+                            (void **)calloc(threads, sizeof(void *))};
+  return builder;
+}
+
+/*
+ * Description: Creates a builder for threads threads of vectors of type
+ *
+ * Type: Init
+ *
+ * Params:
+ *
+ * 	type: type of data
+ *
+ * 	threads: number of threads that submit a vector
+ *
+ * Time Complexity: Constant
+ *
+ * Memory:
+ *
+ * 	threads * sizeof(void *)
+ *
+ * 	Return: vector_builder
+ */
+#define vector_builder_init(type, threads)                                     \
+  __vector_builder_init((threads), sizeof(type))
+
+/*
+ * Description: Hands the vector of thread to builder, which takes ownership
+ * 		of it. Every thread submits at most once per finish
+ *
+ * Type: Modifier
+ *
+ * Params:
+ *
+ * 	builder: the builder to submit to
+ *
+ * 	thread: index of the submitting thread, must be < builder->threads
+ *
+ * 	vector: the vector of thread, may be NULL
+ *
+ * Time Complexity: Constant
+ *
+ * Memory:
+ *
+ * 	0
+ *
+ * 	Return: void
+ */
+static inline void vector_builder_submit(vector_builder *builder,
+                                         size_t thread, void *vector) {
+  builder->locals[thread] = vector;
+}
+
+/*
+ * Internal function:
+ * Copies the bytes of range, walking the submitted vectors in order
+ */
+static inline void *__vector_builder_copy(void *argument) {
+  const __vector_builder_range *range =
+      (const __vector_builder_range *)argument;
+  const vector_builder *builder = range->builder;
+  size_t position = 0;
+  for (size_t t = 0; t < builder->threads && position < range->end; t++) {
+    size_t bytes = vector_size(builder->locals[t]) * builder->item_size;
+    size_t begin = range->begin > position ? range->begin : position;
+    size_t end = range->end < position + bytes ? range->end : position + bytes;
+    if (begin < end) {
+      memcpy(range->destination + begin,
+             (const char *)builder->locals[t] + (begin - position),
+             end - begin);
+    }
+    position += bytes;
+  }
+  return NULL;
+}
+
+/*
+ * Internal function:
+ * Copies every submitted vector to destination, then frees them
+ *
+ * Logic:
+ * split the concatenated bytes into equal ranges, so a single big vector
+ * doesn't serialize the copy, 1 per VECTOR_BUILDER_PARALLEL_BYTES but no
+ * more than the online cpus. Copy every range but the first on its own
+ * thread and the first on the calling thread. If a thread can't be created
+ * its range is copied on the calling thread instead
+ */
+static inline void __vector_builder_finish(vector_builder *builder,
+                                           char *destination, size_t total) {
+  size_t bytes = total * builder->item_size;
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t workers = bytes / VECTOR_BUILDER_PARALLEL_BYTES;
+  if (online > 0 && workers > (size_t)online) {
+    workers = (size_t)online;
+  }
+  if (workers == 0) {
+    workers = 1;
+  }
+  __vector_builder_range *ranges =
+      (__vector_builder_range *)malloc(workers * sizeof(*ranges));
+  pthread_t *ids = (pthread_t *)malloc(workers * sizeof(*ids));
+  int *started = (int *)calloc(workers, sizeof(*started));
+
+  for (size_t w = 0; w < workers; w++) {
+    ranges[w].builder = builder;
+    ranges[w].destination = destination;
+    ranges[w].begin = bytes / workers * w;
+    ranges[w].end = w + 1 == workers ? bytes : bytes / workers * (w + 1);
+    if (w > 0) {
+      started[w] =
+          pthread_create(&ids[w], NULL, __vector_builder_copy, &ranges[w]) == 0;
+    }
+  }
+  for (size_t w = 0; w < workers; w++) {
+    if (!started[w]) {
+      __vector_builder_copy(&ranges[w]);
+    }
+  }
+  for (size_t w = 0; w < workers; w++) {
+    if (started[w]) {
+      pthread_join(ids[w], NULL);
+    }
+  }
+
+  for (size_t t = 0; t < builder->threads; t++) {
+    vector_free(builder->locals[t]);
+    builder->locals[t] = NULL;
+  }
+  free(ranges);
+  free(ids);
+  free(started);
+}
+
+/*
+ * Internal function:
+ * Sum of the sizes of every submitted vector
+ */
+static inline size_t __vector_builder_total(const vector_builder *builder) {
+  size_t total = 0;
+  for (size_t t = 0; t < builder->threads; t++) {
+    total += vector_size(builder->locals[t]);
+  }
+  return total;
+}
+
+/*
+ * Description: Appends every submitted vector, in thread index order, to the
+ * 		end of vector and empties builder so it can be reused
+ *
+ * Type: Modifier (Insertion)
+ *
+ * Params:
+ *
+ * 	builder: the builder to finish, every thread must be done submitting
+ *
+ * 	vector: the vector to append to, TYPE must have the size of the type
+ * 		given to vector_builder_init, otherwise finish aborts
+ *
+ * Time Complexity: Linear, divided by the online cpus
+ *
+ * Memory:
+ * 	Case of vector_size(vector) + total >= capacity:
+ * 		sizeof(*(vector)) bytes * (vector_size(vector) + total) + 2 *
+ * sizeof(size_t)
+ *
+ * 	Return: void
+ */
+#define vector_builder_finish(builder, vector)                                 \
+  do {                                                                         \
+    if (sizeof(*(vector)) != (builder)->item_size) {                           \
+      abort();                                                                 \
+    }                                                                          \
+    size_t __size = vector_size(vector);                                       \
+    size_t __total = __vector_builder_total((builder));                        \
+    vector_reserve(vector, __size + __total);                                  \
+    __vector_builder_finish((builder), (char *)((vector) + __size), __total);  \
+    __vector_set_size(vector, __size + __total);                               \
+  } while (0)
+
+/*
+ * Description: Frees builder and any vector submitted since the last finish
+ *
+ * Type: Modifier (Free)
+ *
+ * Params:
+ *
+ * 	builder: builder to free
+ *
+ * Time Complexity: Linear in builder->threads
+ *
+ * Memory:
+ *
+ * 	-(builder->threads * sizeof(void *))
+ *
+ * 	Return: void
+ */
+static inline void vector_builder_free(vector_builder *builder) {
+  for (size_t t = 0; t < builder->threads; t++) {
+    vector_free(builder->locals[t]);
+  }
+  free(builder->locals);
+  builder->locals = NULL;
+  builder->threads = 0;
+}
+
+#endif // VECTOR_BUILDER_H
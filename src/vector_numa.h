@@ -0,0 +1,360 @@
+/**************************************************************************************************
+ * License: MIT *
+ **************************************************************************************************
+ * Copyright 2020 Scott Nicholas Hackman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef VECTOR_NUMA_H
+#define VECTOR_NUMA_H
+
+#include <pthread.h> // pthread_create, pthread_join
+#include <unistd.h>  // sysconf
+
+#ifdef __linux__
+#include <linux/mempolicy.h> // MPOL_INTERLEAVE, MPOL_PREFERRED, MPOL_MF_MOVE
+#include <sys/syscall.h>     // SYS_mbind, SYS_get_mempolicy
+#endif // __linux__
+
+#include "vector.h"
+
+/*
+ * Vector_Numa parallel first-touch allocation for huge vectors
+ *
+ * An operating system places a page on the NUMA node of the thread that
+ * first writes to it, so a vector filled by a single thread ends up on a
+ * single node. vector_reserve_parallel and vector_init_parallel fault the
+ * new capacity in from several threads, after applying a placement policy.
+ *
+ * Policies:
+ * 		VECTOR_NUMA_PARTITION: split the whole capacity, elements
+ * 			included, into threads chunks of whole pages, the
+ * 			part of chunk t past the elements is bound with mbind
+ * 			to allowed node t * nodes / threads, so a pass that
+ * 			splits the capacity the same way, with its threads
+ * 			pinned to those nodes, reads local memory everywhere
+ * 			but the elements that were already there
+ * 		VECTOR_NUMA_INTERLEAVE: spread the pages round robin over
+ * 			every allowed node with mbind
+ *
+ * Either way the pages are then faulted in parallel. Pages past the size
+ * of the vector that are already resident, from an earlier reserve or a
+ * vector_clear, are moved to their node. Pages partly holding elements or
+ * allocator data keep the default policy. On machines with a single node,
+ * outside of Linux, or when mbind is denied, the policy is skipped and the
+ * pages are only faulted in.
+ *
+ * use #define VECTOR_NUMA_PARALLEL_BYTES to change the size below which
+ * pages are faulted on the calling thread, defaults to 16 MiB
+ *
+ * ---------------------------------------------------------------------
+ * Example                                                             |
+ * ---------------------------------------------------------------------
+ * double* samples = NULL;                                             |
+ * vector_reserve_parallel(samples, 1 << 28, 0,                        |
+ *                         VECTOR_NUMA_INTERLEAVE);                    |
+ * vector_free(samples);                                               |
+ * ---------------------------------------------------------------------
+ *
+ * Note: link with -lpthread
+ */
+
+#ifndef VECTOR_NUMA_PARALLEL_BYTES
+#define VECTOR_NUMA_PARALLEL_BYTES ((size_t)1 << 24)
+#endif // VECTOR_NUMA_PARALLEL_BYTES
+
+typedef enum vector_numa_policy {
+  VECTOR_NUMA_PARTITION,
+  VECTOR_NUMA_INTERLEAVE
+} vector_numa_policy;
+
+/*
+ * Internal struct:
+ * Pages [begin, end) for one thread to fault in
+ */
+typedef struct __vector_numa_range {
+  char *begin;
+  char *end;
+  size_t page;
+} __vector_numa_range;
+
+/*
+ * Internal function:
+ * Writes one byte of every page in range, the bytes are past the size of
+ * the vector so their values don't matter
+ */
+static inline void *__vector_numa_touch(void *argument) {
+  const __vector_numa_range *range = (const __vector_numa_range *)argument;
+  for (char *p = range->begin; p < range->end;
+       p = (char *)(((size_t)p / range->page + 1) * range->page)) {
+    *(volatile char *)p = 0;
+  }
+  return NULL;
+}
+
+/*
+ * Internal function:
+ * Binds the whole pages in [begin, end) with mode over nodes, moving any
+ * page that is already resident. Failures are ignored
+ */
+static inline void __vector_numa_bind(char *begin, char *end, size_t page,
+                                      int mode, const unsigned long *nodes,
+                                      unsigned long max_node) {
+#ifdef __linux__
+  size_t first = ((size_t)begin + page - 1) / page * page;
+  size_t last = (size_t)end / page * page;
+  if (first < last) {
+    syscall(SYS_mbind, first, last - first, mode, nodes, max_node + 1,
+            MPOL_MF_MOVE);
+  }
+#else
+  (void)begin;
+  (void)end;
+  (void)page;
+  (void)mode;
+  (void)nodes;
+  (void)max_node;
+#endif // __linux__
+}
+
+/*
+ * Internal function:
+ * Start of chunk c of the vector data [data, end) split into chunks chunks
+ *
+ * Logic:
+ * split the whole pages of the data evenly, chunk 0 also gets the partial
+ * page at the start and the last chunk the partial page at the end, so
+ * every boundary between 2 chunks is page aligned
+ */
+static inline char *__vector_numa_chunk(char *data, char *end, size_t page,
+                                        size_t chunks, size_t c) {
+  if (c == 0) {
+    return data;
+  }
+  if (c == chunks) {
+    return end;
+  }
+  size_t first = ((size_t)data + page - 1) / page * page;
+  size_t last = (size_t)end / page * page;
+  size_t pages = first < last ? (last - first) / page : 0;
+  return (char *)(first + pages * c / chunks * page);
+}
+
+/*
+ * Internal function:
+ * Applies policy to the whole pages of [begin, end), the part of the vector
+ * data [data, end) past its elements
+ *
+ * Logic:
+ * ask the kernel which nodes this thread may allocate on, if there's more
+ * than 1 either interleave every page over them, or bind the part of chunk
+ * c past the elements to the (c * nodes / chunks)th allowed node with
+ * MPOL_PREFERRED, which still falls back to other nodes once that one is
+ * full. Any failure leaves the default policy in place
+ */
+static inline void __vector_numa_place(char *data, char *begin, char *end,
+                                       size_t page, size_t chunks,
+                                       vector_numa_policy policy) {
+#ifdef __linux__
+  unsigned long nodes[16] = {0};
+  unsigned long max_node = sizeof(nodes) * 8;
+  int mode = 0;
+  if (syscall(SYS_get_mempolicy, &mode, nodes, max_node, NULL,
+              MPOL_F_MEMS_ALLOWED) != 0) {
+    return;
+  }
+  size_t count = 0;
+  for (size_t i = 0; i < sizeof(nodes) / sizeof(*nodes); i++) {
+    count += (size_t)__builtin_popcountl(nodes[i]);
+  }
+  if (count <= 1) {
+    return;
+  }
+  if (policy == VECTOR_NUMA_INTERLEAVE) {
+    __vector_numa_bind(begin, end, page, MPOL_INTERLEAVE, nodes, max_node);
+    return;
+  }
+
+  size_t word = 8 * sizeof(*nodes);
+  for (size_t c = 0; c < chunks; c++) {
+    char *chunk_begin = __vector_numa_chunk(data, end, page, chunks, c);
+    char *chunk_end = __vector_numa_chunk(data, end, page, chunks, c + 1);
+    if (chunk_end <= begin) {
+      continue;
+    }
+    size_t target = c * count / chunks;
+    unsigned long node[sizeof(nodes) / sizeof(*nodes)] = {0};
+    for (size_t bit = 0; bit < max_node; bit++) {
+      if (((nodes[bit / word] >> (bit % word)) & 1) && target-- == 0) {
+        node[bit / word] = 1UL << (bit % word);
+        break;
+      }
+    }
+    __vector_numa_bind(chunk_begin > begin ? chunk_begin : begin, chunk_end,
+                       page, MPOL_PREFERRED, node, max_node);
+  }
+#else
+  (void)data;
+  (void)begin;
+  (void)end;
+  (void)page;
+  (void)chunks;
+  (void)policy;
+#endif // __linux__
+}
+
+/*
+ * Internal function:
+ * Applies policy to [begin, end), the part of the vector data [data, end)
+ * past its elements, then faults it in from threads threads
+ *
+ * Logic:
+ * threads == 0 means 1 per online cpu. Place the data as threads chunks,
+ * then fault in the part of every chunk past begin, on 1 thread if that's
+ * smaller than VECTOR_NUMA_PARALLEL_BYTES. Fault every chunk but the first
+ * on its own thread and the first on the calling thread. If a thread can't
+ * be created its chunk is faulted on the calling thread instead
+ */
+static inline void __vector_numa_first_touch(char *data, char *begin,
+                                             char *end, size_t threads,
+                                             vector_numa_policy policy) {
+  if (begin >= end) {
+    return;
+  }
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t pages = ((size_t)(end - data) + page - 1) / page;
+  if (threads == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = online > 0 ? (size_t)online : 1;
+  }
+  if (pages < threads) {
+    threads = pages;
+  }
+  __vector_numa_place(data, begin, end, page, threads, policy);
+  if ((size_t)(end - begin) < VECTOR_NUMA_PARALLEL_BYTES) {
+    threads = 1;
+  }
+
+  __vector_numa_range *ranges =
+      (__vector_numa_range *)malloc(threads * sizeof(*ranges));
+  pthread_t *ids = (pthread_t *)malloc(threads * sizeof(*ids));
+  int *started = (int *)calloc(threads, sizeof(*started));
+
+  for (size_t t = 0; t < threads; t++) {
+    char *chunk_begin = __vector_numa_chunk(data, end, page, threads, t);
+    char *chunk_end = __vector_numa_chunk(data, end, page, threads, t + 1);
+    ranges[t].begin = chunk_begin > begin ? chunk_begin : begin;
+    ranges[t].end = chunk_end > begin ? chunk_end : begin;
+    ranges[t].page = page;
+    if (t > 0 && ranges[t].begin < ranges[t].end) {
+      started[t] =
+          pthread_create(&ids[t], NULL, __vector_numa_touch, &ranges[t]) == 0;
+    }
+  }
+  for (size_t t = 0; t < threads; t++) {
+    if (!started[t]) {
+      __vector_numa_touch(&ranges[t]);
+    }
+  }
+  for (size_t t = 0; t < threads; t++) {
+    if (started[t]) {
+      pthread_join(ids[t], NULL);
+    }
+  }
+  free(ranges);
+  free(ids);
+  free(started);
+}
+
+/*
+ * Internal function:
+ * __vector_alloc, then fault in everything past the size of the vector
+ */
+static inline void *__vector_alloc_parallel(void *vector, size_t new_capacity,
+                                            size_t size_of_item,
+                                            size_t threads,
+                                            vector_numa_policy policy) {
+  char *new_vector = (char *)__vector_alloc(vector, new_capacity, size_of_item);
+  __vector_numa_first_touch(new_vector,
+                            new_vector + vector_size(new_vector) * size_of_item,
+                            new_vector + new_capacity * size_of_item, threads,
+                            policy);
+  return new_vector;
+}
+
+/*
+ * Description: vector_reserve, with the new capacity placed by policy and
+ * 		faulted in by threads threads
+ *
+ * Type: Modifier
+ *
+ * Params:
+ *
+ * 	vector: to change the capacity of
+ *
+ * 	new_capacity: capacity to set it to
+ *
+ * 	threads: number of threads to fault pages in, 0 for 1 per online cpu
+ *
+ * 	policy: VECTOR_NUMA_PARTITION or VECTOR_NUMA_INTERLEAVE
+ *
+ * Time Complexity: Linear, divided by threads
+ *
+ * Memory:
+ *
+ * 	2 * sizeof(size_t) + new_capacity * sizeof(*(vector)), all resident
+ *
+ *
+ * Return: void
+ */
+#define vector_reserve_parallel(vector, new_capacity, threads, policy)         \
+  if ((new_capacity) >= vector_capacity(vector)) {                             \
+    vector = __vector_alloc_parallel((vector), (new_capacity),                 \
+                                     sizeof(*(vector)), (threads), (policy));  \
+  }
+
+/*
+ * Description: vector_init, with the capacity placed by policy and faulted
+ * 		in by threads threads
+ *
+ * Type: Init
+ *
+ * Params:
+ *
+ * 	type: type of data
+ *
+ * 	capacity: new capacity to set vector to
+ *
+ * 	threads: number of threads to fault pages in, 0 for 1 per online cpu
+ *
+ * 	policy: VECTOR_NUMA_PARTITION or VECTOR_NUMA_INTERLEAVE
+ *
+ * Time Complexity: Linear, divided by threads
+ *
+ * Memory:
+ *
+ * 	sizeof(type) * capacity + 2 * sizeof(size_t), all resident
+ *
+ * 	Return: void* (the new vector)
+ */
+#define vector_init_parallel(type, capacity, threads, policy)                  \
+  __vector_alloc_parallel(NULL, (capacity), sizeof(type), (threads), (policy))
+
+#endif // VECTOR_NUMA_H
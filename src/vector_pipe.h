@@ -0,0 +1,207 @@
+/**************************************************************************************************
+ * License: MIT *
+ **************************************************************************************************
+ * Copyright 2020 Scott Nicholas Hackman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef VECTOR_PIPE_H
+#define VECTOR_PIPE_H
+
+#include <stdint.h> // SIZE_MAX
+
+#include "vector.h"
+
+/*
+ * Vector_Pipe fused filter/map/take/collect/reduce over a vector
+ *
+ * vector_pipe expands to a single for loop over vector, every stage is
+ * a statement inside of that loop, so no intermediate vectors are made.
+ * The last stage is a terminal, collect or reduce.
+ *
+ * Stages:
+ * 		filter(condition), map(name, expression), take(n)
+ *
+ * Terminals:
+ * 		collect(vector, value), reduce(accumulator, expression)
+ *
+ * Convention:
+ * map declares a new variable, of the type of its expression, that later
+ * stages refer to by name. At most 1 take and 1 collect per pipe, and at
+ * most 8 stages.
+ *
+ * ---------------------------------------------------------------------
+ * Example                                                             |
+ * ---------------------------------------------------------------------
+ * long* squares = NULL;                                               |
+ * long sum = 0;                                                       |
+ * vector_pipe(numbers, x,                                             |
+ *             vector_pipe_filter(x % 2 == 0),                         |
+ *             vector_pipe_map(square, (long)x * x),                   |
+ *             vector_pipe_take(10),                                   |
+ *             vector_pipe_collect(squares, square));                  |
+ *                                                                     |
+ * vector_pipe(squares, square,                                        |
+ *             vector_pipe_reduce(sum, sum + square));                 |
+ * ---------------------------------------------------------------------
+ *
+ * Note: the size of vector is read once, vector must not be modified by
+ * the stages
+ */
+
+/*
+ * Internal macros:
+ * Join the comma separated stages of vector_pipe into statements
+ */
+#define __VECTOR_PIPE_CAT(a, b) __VECTOR_PIPE_CAT_(a, b)
+#define __VECTOR_PIPE_CAT_(a, b) a##b
+#define __VECTOR_PIPE_COUNT(_1, _2, _3, _4, _5, _6, _7, _8, count, ...) count
+#define __VECTOR_PIPE_STAGES(...)                                              \
+  __VECTOR_PIPE_CAT(__VECTOR_PIPE_,                                            \
+                    __VECTOR_PIPE_COUNT(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1))  \
+  (__VA_ARGS__)
+#define __VECTOR_PIPE_1(stage) stage;
+#define __VECTOR_PIPE_2(stage, ...) stage; __VECTOR_PIPE_1(__VA_ARGS__)
+#define __VECTOR_PIPE_3(stage, ...) stage; __VECTOR_PIPE_2(__VA_ARGS__)
+#define __VECTOR_PIPE_4(stage, ...) stage; __VECTOR_PIPE_3(__VA_ARGS__)
+#define __VECTOR_PIPE_5(stage, ...) stage; __VECTOR_PIPE_4(__VA_ARGS__)
+#define __VECTOR_PIPE_6(stage, ...) stage; __VECTOR_PIPE_5(__VA_ARGS__)
+#define __VECTOR_PIPE_7(stage, ...) stage; __VECTOR_PIPE_6(__VA_ARGS__)
+#define __VECTOR_PIPE_8(stage, ...) stage; __VECTOR_PIPE_7(__VA_ARGS__)
+
+/*
+ * Description: Runs stages over every element of vector in a single pass
+ *
+ * Type: Pipe
+ *
+ * Params:
+ *
+ * 	vector: the vector to read from
+ *
+ * 	x: name of the current element, of type TYPE
+ *
+ * 	...: stages, ending with a terminal
+ *
+ * Time Complexity: Linear
+ *
+ * Memory:
+ *
+ * 	0, besides what the terminal allocates
+ *
+ * 	Return: void
+ */
+#define vector_pipe(vector, x, ...)                                            \
+  for (size_t __pipe_i = 0, __pipe_size = vector_size(vector),                 \
+              __pipe_taken = 0, __pipe_limit = SIZE_MAX, __pipe_reserved = 0;  \
+       __pipe_i < __pipe_size && __pipe_taken < __pipe_limit; __pipe_i++) {    \
+    __typeof__(*(vector)) x = (vector)[__pipe_i];                              \
+    (void)__pipe_reserved;                                                     \
+    __VECTOR_PIPE_STAGES(__VA_ARGS__)                                          \
+  }
+
+/*
+ * Description: Skips the current element unless condition holds
+ *
+ * Type: Stage
+ *
+ * Params:
+ *
+ * 	condition: expression of earlier names
+ */
+#define vector_pipe_filter(condition)                                          \
+  if (!(condition))                                                            \
+  continue
+
+/*
+ * Description: Declares name = expression for the following stages
+ *
+ * Type: Stage
+ *
+ * Params:
+ *
+ * 	name: new name, must not be used by an earlier stage
+ *
+ * 	expression: expression of earlier names
+ */
+#define vector_pipe_map(name, expression)                                      \
+  __typeof__(expression) name = (expression)
+
+/*
+ * Description: Stops the pipe after n elements reached this stage
+ *
+ * Type: Stage
+ *
+ * Params:
+ *
+ * 	n: the maximum number of elements to pass on
+ */
+#define vector_pipe_take(n)                                                    \
+  if (__pipe_taken >= (__pipe_limit = (n)))                                    \
+    break;                                                                     \
+  else                                                                         \
+    __pipe_taken++
+
+/*
+ * Description: Appends value to the end of vector, reserving space for every
+ * 		element that can still reach it the first time it runs
+ *
+ * Type: Terminal
+ *
+ * Params:
+ *
+ * 	vector: the vector to append to
+ *
+ * 	value: expression of earlier names
+ *
+ * Memory:
+ * 	Case of first element:
+ * 		sizeof(*(vector)) bytes * (vector_size(vector) + upper bound) + 2 *
+ * sizeof(size_t)
+ */
+#define vector_pipe_collect(vector, value)                                     \
+  do {                                                                         \
+    if (!__pipe_reserved) {                                                    \
+      size_t __bound = __pipe_size - __pipe_i;                                 \
+      if (__pipe_limit != SIZE_MAX &&                                          \
+          __pipe_limit - __pipe_taken + 1 < __bound) {                         \
+        __bound = __pipe_limit - __pipe_taken + 1;                             \
+      }                                                                        \
+      vector_reserve(vector, vector_size(vector) + __bound);                   \
+      __pipe_reserved = 1;                                                     \
+    }                                                                          \
+    (vector)[vector_size(vector)] = (value);                                   \
+    __vector_set_size(vector, vector_size(vector) + 1);                        \
+  } while (0)
+
+/*
+ * Description: Folds every element into accumulator
+ *
+ * Type: Terminal
+ *
+ * Params:
+ *
+ * 	accumulator: variable declared before vector_pipe
+ *
+ * 	expression: new value of accumulator, of earlier names and accumulator
+ */
+#define vector_pipe_reduce(accumulator, expression)                            \
+  accumulator = (expression)
+
+#endif // VECTOR_PIPE_H
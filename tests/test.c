@@ -1,10 +1,15 @@
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <sys/mman.h>
 
 #include <cmocka.h>
 
 #include "../src/vector.h"
+#include "../src/delta_vector.h"
+#include "../src/vector_pipe.h"
+#include "../src/vector_builder.h"
+#include "../src/vector_numa.h"
 
 void size_on_null(void **state) { assert_int_equal(vector_size(NULL), 0); }
 
@@ -269,6 +274,284 @@ void push_back_plus_plus(void **state) {
   vector_free(vector);
 }
 
+void delta_vector_at_on_300(void **state) {
+  delta_vector dv = {0};
+  for (uint64_t i = 0; i < 300; i++) {
+    delta_vector_push_back(&dv, i * 7);
+  }
+  assert_int_equal(delta_vector_size(&dv), 300);
+  assert_int_equal(delta_vector_blocks(&dv), 3);
+  assert_int_equal(delta_vector_at(&dv, 0), 0);
+  assert_int_equal(delta_vector_at(&dv, 129), 129 * 7);
+  assert_int_equal(delta_vector_at(&dv, 299), 299 * 7);
+  delta_vector_free(&dv);
+  assert_int_equal(delta_vector_size(&dv), 0);
+}
+
+void delta_vector_decode_unsorted(void **state) {
+  delta_vector dv = {0};
+  uint64_t values[] = {5, 0, UINT64_MAX, 1, UINT64_MAX / 2, 42};
+  for (size_t i = 0; i < 1000; i++) {
+    delta_vector_push_back(&dv, values[i % 6] + i);
+  }
+  uint64_t *vector = NULL;
+  vector_push_back(vector, 9);
+  delta_vector_decode(&dv, vector);
+  assert_int_equal(vector_size(vector), 1001);
+  assert_int_equal(vector_front(vector), 9);
+  for (size_t i = 0; i < 1000; i++) {
+    assert_true(vector[i + 1] == values[i % 6] + i);
+    assert_true(delta_vector_at(&dv, i) == values[i % 6] + i);
+  }
+  vector_free(vector);
+  delta_vector_free(&dv);
+}
+
+void delta_vector_decode_wide(void **state) {
+  delta_vector dv = {0};
+  uint64_t *expected = NULL;
+  uint64_t value = 0;
+  for (unsigned width = 57; width < 64; width++) {
+    for (uint64_t i = 0; i < DELTA_VECTOR_BLOCK; i++) {
+      value += ((uint64_t)1 << (width - 2)) + i;
+      delta_vector_push_back(&dv, value);
+      vector_push_back(expected, value);
+    }
+    assert_int_equal(dv.data[dv.offsets[width - 57]], width);
+  }
+  uint64_t *vector = NULL;
+  delta_vector_decode(&dv, vector);
+  assert_int_equal(vector_size(vector), 7 * DELTA_VECTOR_BLOCK);
+  int equal = 1;
+  for (size_t i = 0; i < vector_size(expected); i++) {
+    equal &= vector[i] == expected[i];
+    equal &= delta_vector_at(&dv, i) == expected[i];
+  }
+  assert_true(equal);
+  for (size_t block = 0; block < 7; block++) {
+    size_t last = (block + 1) * DELTA_VECTOR_BLOCK - 1;
+    assert_true(delta_vector_at(&dv, last) == expected[last]);
+    assert_true(vector[last] == expected[last]);
+  }
+  vector_free(vector);
+  vector_free(expected);
+  delta_vector_free(&dv);
+}
+
+void delta_vector_seek_sorted(void **state) {
+  delta_vector dv = {0};
+  for (uint64_t i = 0; i < 1000; i++) {
+    delta_vector_push_back(&dv, 1000 + i * 2);
+  }
+  assert_int_equal(delta_vector_seek(&dv, 0), 0);
+  assert_int_equal(delta_vector_seek(&dv, 1000 + 2 * 256), 2);
+  assert_int_equal(delta_vector_seek(&dv, 1000 + 2 * 255), 1);
+  assert_int_equal(delta_vector_seek(&dv, UINT64_MAX), 7);
+  assert_true(vector_size(dv.data) < 1000);
+  int *vector = NULL;
+  delta_vector_decode(&dv, vector);
+  assert_int_equal(vector_size(vector), 1000);
+  assert_int_equal(vector_back(vector), 1000 + 999 * 2);
+  vector_free(vector);
+  delta_vector_free(&dv);
+}
+
+void pipe_filter_map_collect(void **state) {
+  int *vector = NULL;
+  for (int i = 0; i < 100; i++) {
+    vector_push_back(vector, i);
+  }
+  long *squares = NULL;
+  vector_pipe(vector, x, vector_pipe_filter(x % 2 == 0),
+              vector_pipe_map(square, (long)x * x),
+              vector_pipe_collect(squares, square));
+  assert_int_equal(vector_size(squares), 50);
+  assert_int_equal(vector_capacity(squares), 100);
+  assert_int_equal(vector_back(squares), 98 * 98);
+  vector_free(squares);
+  vector_free(vector);
+}
+
+void pipe_take_reserves_once(void **state) {
+  int *vector = NULL;
+  for (int i = 0; i < 100; i++) {
+    vector_push_back(vector, i);
+  }
+  int *odds = NULL;
+  vector_pipe(vector, x, vector_pipe_filter(x % 2), vector_pipe_take(10),
+              vector_pipe_collect(odds, x));
+  assert_int_equal(vector_size(odds), 10);
+  assert_int_equal(vector_capacity(odds), 10);
+  assert_int_equal(vector_back(odds), 19);
+  int *none = NULL;
+  vector_pipe(vector, x, vector_pipe_take(0), vector_pipe_collect(none, x));
+  assert_null(none);
+  vector_free(odds);
+  vector_free(vector);
+}
+
+void pipe_reduce(void **state) {
+  int *vector = NULL;
+  for (int i = 1; i <= 100; i++) {
+    vector_push_back(vector, i);
+  }
+  long sum = 0;
+  vector_pipe(vector, x, vector_pipe_map(doubled, x * 2),
+              vector_pipe_reduce(sum, sum + doubled));
+  assert_int_equal(sum, 10100);
+  vector_free(vector);
+}
+
+typedef struct builder_worker {
+  vector_builder *builder;
+  size_t thread;
+  int count;
+} builder_worker;
+
+void *builder_push(void *argument) {
+  builder_worker *worker = (builder_worker *)argument;
+  int *local = NULL;
+  for (int i = 0; i < worker->count; i++) {
+    vector_push_back(local, (int)worker->thread * worker->count + i);
+  }
+  vector_builder_submit(worker->builder, worker->thread, local);
+  return NULL;
+}
+
+void builder_finish_in_thread_order(void **state) {
+  vector_builder builder = vector_builder_init(int, 8);
+  pthread_t ids[8];
+  builder_worker workers[8];
+  for (size_t t = 0; t < 8; t++) {
+    workers[t] = (builder_worker){&builder, t, 100000};
+    pthread_create(&ids[t], NULL, builder_push, &workers[t]);
+  }
+  for (size_t t = 0; t < 8; t++) {
+    pthread_join(ids[t], NULL);
+  }
+  int *vector = NULL;
+  vector_push_back(vector, -1);
+  vector_builder_finish(&builder, vector);
+  assert_int_equal(vector_size(vector), 800001);
+  assert_int_equal(vector_capacity(vector), 800001);
+  int ordered = 1;
+  for (int i = 0; i < 800000; i++) {
+    ordered &= vector[i + 1] == i;
+  }
+  assert_true(ordered);
+  assert_int_equal(vector_front(vector), -1);
+  vector_free(vector);
+  vector_builder_free(&builder);
+}
+
+void builder_finish_skips_empty(void **state) {
+  vector_builder builder = vector_builder_init(int, 3);
+  builder_worker worker = {&builder, 1, 5};
+  builder_push(&worker);
+  int *vector = NULL;
+  vector_builder_finish(&builder, vector);
+  assert_int_equal(vector_size(vector), 5);
+  assert_int_equal(vector_back(vector), 9);
+  assert_null(builder.locals[1]);
+  vector_free(vector);
+  vector_builder_free(&builder);
+}
+
+/*
+ * 1 if every whole page in [begin, end) is resident
+ */
+int numa_resident(char *begin, char *end) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t first = ((size_t)begin + page - 1) / page * page;
+  size_t last = (size_t)end / page * page;
+  size_t pages = (last - first) / page;
+  unsigned char *resident = (unsigned char *)malloc(pages);
+  int all = mincore((void *)first, last - first, resident) == 0;
+  for (size_t i = 0; all && i < pages; i++) {
+    all = resident[i] & 1;
+  }
+  free(resident);
+  return all;
+}
+
+/*
+ * Mode policy gives a page on this machine, -1 if the kernel can't tell
+ */
+int numa_expected_mode(vector_numa_policy policy) {
+#ifdef __linux__
+  unsigned long nodes[16] = {0};
+  int mode = 0;
+  if (syscall(SYS_get_mempolicy, &mode, nodes, sizeof(nodes) * 8, NULL,
+              MPOL_F_MEMS_ALLOWED) != 0) {
+    return -1;
+  }
+  size_t count = 0;
+  for (size_t i = 0; i < sizeof(nodes) / sizeof(*nodes); i++) {
+    count += (size_t)__builtin_popcountl(nodes[i]);
+  }
+  if (count <= 1) {
+    return MPOL_DEFAULT;
+  }
+  return policy == VECTOR_NUMA_INTERLEAVE ? MPOL_INTERLEAVE : MPOL_PREFERRED;
+#else
+  return -1;
+#endif // __linux__
+}
+
+/*
+ * Mode of the page at address, -1 if the kernel can't tell
+ */
+int numa_mode(void *address) {
+#ifdef __linux__
+  int mode = 0;
+  if (syscall(SYS_get_mempolicy, &mode, NULL, 0, address, MPOL_F_ADDR) != 0) {
+    return -1;
+  }
+  return mode;
+#else
+  return -1;
+#endif // __linux__
+}
+
+void reserve_parallel_keeps_elements(void **state) {
+  int *vector = NULL;
+  for (int i = 0; i < 100; i++) {
+    vector_push_back(vector, i);
+  }
+  vector_reserve_parallel(vector, 1 << 23, 4, VECTOR_NUMA_PARTITION);
+  assert_int_equal(vector_capacity(vector), 1 << 23);
+  assert_int_equal(vector_size(vector), 100);
+  assert_int_equal(vector_back(vector), 99);
+  assert_true(numa_resident((char *)(vector + 100),
+                            (char *)(vector + (1 << 23))));
+  int expected = numa_expected_mode(VECTOR_NUMA_PARTITION);
+  int mode = numa_mode(vector + (1 << 22));
+  if (expected >= 0 && mode >= 0) {
+    assert_int_equal(mode, expected);
+  }
+  vector_reserve_parallel(vector, 10, 4, VECTOR_NUMA_PARTITION);
+  assert_int_equal(vector_capacity(vector), 1 << 23);
+  vector_free(vector);
+}
+
+void init_parallel_interleave(void **state) {
+  long *vector =
+      vector_init_parallel(long, 1 << 22, 0, VECTOR_NUMA_INTERLEAVE);
+  assert_int_equal(vector_capacity(vector), 1 << 22);
+  assert_int_equal(vector_size(vector), 0);
+  assert_true(numa_resident((char *)vector, (char *)(vector + (1 << 22))));
+  int expected = numa_expected_mode(VECTOR_NUMA_INTERLEAVE);
+  int mode = numa_mode(vector + (1 << 21));
+  if (expected >= 0 && mode >= 0) {
+    assert_int_equal(mode, expected);
+  }
+  for (long i = 0; i < (1 << 22); i++) {
+    vector_push_back(vector, i);
+  }
+  assert_int_equal(vector_back(vector), (1 << 22) - 1);
+  vector_free(vector);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
       cmocka_unit_test(size_on_null),
@@ -300,7 +583,18 @@ int main(void) {
       cmocka_unit_test(pop_back_on_5),
       cmocka_unit_test(reserve_lower_than_current_capacity),
       cmocka_unit_test(reserve_100_on_12),
-      cmocka_unit_test(push_back_plus_plus)};
+      cmocka_unit_test(push_back_plus_plus),
+      cmocka_unit_test(delta_vector_at_on_300),
+      cmocka_unit_test(delta_vector_decode_unsorted),
+      cmocka_unit_test(delta_vector_decode_wide),
+      cmocka_unit_test(delta_vector_seek_sorted),
+      cmocka_unit_test(pipe_filter_map_collect),
+      cmocka_unit_test(pipe_take_reserves_once),
+      cmocka_unit_test(pipe_reduce),
+      cmocka_unit_test(builder_finish_in_thread_order),
+      cmocka_unit_test(builder_finish_skips_empty),
+      cmocka_unit_test(reserve_parallel_keeps_elements),
+      cmocka_unit_test(init_parallel_interleave)};
 
   int count_fail_tests = cmocka_run_group_tests(tests, NULL, NULL);
   return count_fail_tests;